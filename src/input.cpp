@@ -0,0 +1,180 @@
+#include "input.h"
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <vector>
+
+using namespace std;
+
+// read buffer for parser input
+static const size_t	INPUT_BUFLEN = 1 << 20;
+
+struct Decompressor {
+	const char*	magic;	// leading bytes of the format
+	size_t		len;
+	const char*	prog;	// decompressor reading stdin and writing stdout
+};
+
+// no first byte of these can start a DIMACS, RUP or LRAT file
+static const Decompressor	decompressors[] = {
+	{ "\x1f\x8b", 2, "gzip" },
+	{ "\xfd\x37\x7a\x58\x5a\x00", 6, "xz" },
+	{ "\x28\xb5\x2f\xfd", 4, "zstd" },
+	{ NULL, 0, NULL }
+};
+
+static vector<FILE*>	streams;	// returned by open_input()
+static vector<pid_t>	children;	// decompressors and feeders
+
+static FILE* set_buffer( FILE* f )
+{
+	setvbuf( f, NULL, _IOFBF, INPUT_BUFLEN );
+	return f;
+}
+
+static pid_t spawn()
+{
+	pid_t	pid = fork();
+	if( pid < 0 ) {
+		perror( "fork" );
+		exit( 2 );
+	}
+	if( pid > 0 )
+		children.push_back( pid );
+	else {
+		// an early close must kill the child by SIGPIPE, even if we were
+		// started with SIGPIPE ignored
+		signal( SIGPIPE, SIG_DFL );
+	}
+	return pid;
+}
+
+static void write_all( int fd, const char* buf, size_t n )
+{
+	for( size_t done=0; done<n; ) {
+		ssize_t	w = write( fd, buf+done, n-done );
+		if( w <= 0 )
+			_exit( 1 );
+		done += w;
+	}
+}
+
+/* Writes the magic bytes already read, then copies everything left in f
+ * (including what stdio has already buffered) to fd. Runs in a child
+ * process when f can't be handed over directly. */
+static void feed( const char* magic, size_t len, FILE* f, int fd )
+{
+	write_all( fd, magic, len );
+	char*	buf = new char[INPUT_BUFLEN];
+	size_t	n;
+	while( (n = fread( buf, 1, INPUT_BUFLEN, f )) > 0 )
+		write_all( fd, buf, n );
+	_exit( ferror( f )? 1: 0 );
+}
+
+static FILE* decompress( FILE* f, const Decompressor* d )
+{
+	int	out[2];
+	if( pipe( out ) != 0 ) {
+		perror( "pipe" );
+		exit( 2 );
+	}
+	// later children must not keep our end open
+	fcntl( out[0], F_SETFD, FD_CLOEXEC );
+
+	// the decompressor's stdin: the file itself if we can rewind it,
+	// otherwise a pipe fed by a child process
+	int	in_fd;
+	if( fseek( f, 0, SEEK_SET ) == 0 ) {
+		in_fd = dup( fileno(f) );
+		lseek( in_fd, 0, SEEK_SET );
+	}
+	else {
+		int	in[2];
+		if( pipe( in ) != 0 ) {
+			perror( "pipe" );
+			exit( 2 );
+		}
+		if( spawn() == 0 ) {
+			close( in[0] );
+			close( out[0] );
+			close( out[1] );
+			feed( d->magic, d->len, f, in[1] );
+		}
+		close( in[1] );
+		in_fd = in[0];
+	}
+
+	if( spawn() == 0 ) {
+		dup2( in_fd, 0 );
+		dup2( out[1], 1 );
+		close( in_fd );
+		close( out[0] );
+		close( out[1] );
+		execlp( d->prog, d->prog, "-dc", (char*)NULL );
+		perror( d->prog );
+		_exit( 2 );
+	}
+	close( in_fd );
+	close( out[1] );
+	fclose( f );
+	return set_buffer( fdopen( out[0], "r" ) );
+}
+
+FILE* open_input( const char* path )
+{
+	FILE*	f = (path == NULL)? stdin: fopen( path, "r" );
+	if( f == NULL )
+		return NULL;
+	set_buffer( f );	// must precede any I/O on f
+
+	int	c = fgetc( f );
+	if( c == EOF ) {	// empty for now (it may still grow)
+		clearerr( f );
+		streams.push_back( f );
+		return f;
+	}
+	ungetc( c, f );
+	for( const Decompressor* d=decompressors; d->prog; d++ )
+	{
+		if( c != (unsigned char)d->magic[0] )
+			continue;
+		// the first byte rules out plain text, so the rest must match
+		char	magic[8];
+		if( fread( magic, 1, d->len, f ) != d->len
+			|| memcmp( magic, d->magic, d->len ) != 0 ) {
+			fprintf( stderr, "%s: unrecognized input format\n",
+					 path? path: "stdin" );
+			exit( 2 );
+		}
+		f = decompress( f, d );
+		break;
+	}
+	streams.push_back( f );
+	return f;
+}
+
+bool close_inputs()
+{
+	for( size_t i=0; i<streams.size(); i++ )
+		fclose( streams[i] );
+	streams.clear();
+
+	// closing a pipe early kills its writer with SIGPIPE, which is fine
+	bool	ok = true;
+	for( size_t i=0; i<children.size(); i++ )
+	{
+		int	status;
+		if( waitpid( children[i], &status, 0 ) < 0 )
+			ok = false;
+		else if( WIFEXITED(status) )
+			ok = ok && WEXITSTATUS(status) == 0;
+		else
+			ok = ok && WIFSIGNALED(status) && WTERMSIG(status) == SIGPIPE;
+	}
+	children.clear();
+	return ok;
+}
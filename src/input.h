@@ -0,0 +1,18 @@
+#ifndef input__h
+#define input__h
+
+#include <stdio.h>
+
+/* Opens an input file (stdin if path is NULL) for the parser.
+ * gzip, xz and zstd compressed inputs are detected from their magic bytes
+ * and decompressed on the fly by a background decompressor process, so
+ * the returned stream always yields plain text (or binary LRAT).
+ * Returns NULL if the file cannot be opened. */
+FILE* open_input( const char* path );
+
+/* Closes every stream returned by open_input() and waits for the
+ * decompressor processes. Returns false if any of them failed, e.g. on a
+ * corrupt or truncated archive or a missing decompressor. */
+bool close_inputs();
+
+#endif
@@ -0,0 +1,133 @@
+#include "lrat.h"
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace std;
+
+//////////////////////////////////////////////////////////////////////////////
+// public interface
+
+LratChecker::LratChecker( unsigned _num_vars )
+{
+	num_vars = _num_vars;
+
+	pa = new char[num_vars+1];
+	fill( pa, pa+num_vars+1, UN );
+
+	assigned = new Literal[num_vars+1];
+	assignedEnd = assigned;
+
+	clauses.push_back( NULL );	// [0] is not used
+	contradiction = false;
+}
+
+LratChecker::~LratChecker()
+{
+	for( size_t i=0; i<clauses.size(); i++ )
+		delete[] clauses[i];
+	delete[] pa;
+	delete[] assigned;
+}
+
+bool LratChecker::_inRange( Clause c ) const
+{
+	for( Literal* it=c; *it; it++ ) {
+		if( (unsigned)abs( *it ) > num_vars )
+			return false;
+	}
+	return true;
+}
+
+bool LratChecker::addOriginal( Clause c )
+{
+	if( !_inRange( c ) )
+		return false;
+	clauses.push_back( c );
+	if( c[0] == 0 )
+		contradiction = true;
+	return true;
+}
+
+bool LratChecker::check( int id, Clause c, const int* hints )
+{
+	if( id <= 0 || ((size_t)id < clauses.size() && clauses[id] != NULL) )
+		return false;	// ids must be fresh
+	if( !_inRange( c ) )	// every stored clause is in range
+		return false;
+
+	// assume the negation of the lemma
+	bool	ok = false;
+	for( Literal* it=c; *it; it++ )
+	{
+		int	v = abs( *it );
+		if( pa[v] == getSign(*it) ) {	// tautology
+			ok = true;
+			break;
+		}
+		if( pa[v] == UN )
+			_assign( -*it );
+	}
+	if( !ok )
+		ok = _propagate( hints );
+	_reset();
+	if( !ok )
+		return false;
+
+	if( (size_t)id >= clauses.size() )
+		clauses.resize( id+1, (Clause)NULL );
+	clauses[id] = c;
+	if( c[0] == 0 )
+		contradiction = true;
+	return true;
+}
+
+void LratChecker::remove( int id )
+{
+	if( id <= 0 || (size_t)id >= clauses.size() )
+		return;
+	delete[] clauses[id];
+	clauses[id] = NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// unit propagation over the hints
+
+void LratChecker::_assign( Literal l )
+{
+	pa[abs(l)] = getSign( l );
+	*assignedEnd++ = l;
+}
+
+void LratChecker::_reset()
+{
+	for( Literal* it=assigned; it!=assignedEnd; it++ )
+		pa[abs(*it)] = UN;
+	assignedEnd = assigned;
+}
+
+/* Each hint must be unit (then its literal is assigned) or falsified
+ * (then we are done) under the current assignment. */
+bool LratChecker::_propagate( const int* hints )
+{
+	for( ; *hints; hints++ )
+	{
+		int	id = *hints;
+		if( id < 0 || (size_t)id >= clauses.size() || clauses[id] == NULL )
+			return false;	// RAT hints or unknown clauses are not supported
+		Literal	unit = 0;
+		for( Literal* it=clauses[id]; *it; it++ )
+		{
+			char	val = pa[abs(*it)];
+			if( val == getNegSign(*it) )	// falsified
+				continue;
+			if( val == getSign(*it) || unit != 0 )	// not unit
+				return false;
+			unit = *it;
+		}
+		if( unit == 0 )	// conflict
+			return true;
+		_assign( unit );
+	}
+	return false;
+}
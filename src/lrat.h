@@ -0,0 +1,42 @@
+#ifndef lrat__h
+#define lrat__h
+
+#include "solver.h"
+
+/* Checks LRAT proofs. Every lemma comes with the ids of its antecedent
+ * clauses in propagation order, so a lemma is checked by replaying unit
+ * propagation over the listed clauses only. No watch lists are needed and
+ * checking is linear in the size of the proof. */
+class LratChecker
+{
+public:	// public interface
+	LratChecker( unsigned _num_vars );
+	~LratChecker();
+
+	// original clauses are numbered from 1 in input order
+	// (returns false if c has a variable above num_vars)
+	bool addOriginal( Clause c );
+
+	// checks a lemma with its hints (0-terminated) and adds it with the id
+	bool check( int id, Clause c, const int* hints );
+	void remove( int id );
+
+	// true once the empty clause was added
+	bool isContradicted() const { return contradiction; }
+
+protected:
+	unsigned	num_vars;
+	char*		pa;			// partial assignment (values in UN,TT,FF)
+	Literal*	assigned;	// assigned literals to reset after a check
+	Literal*	assignedEnd;
+
+	vector<Clause>	clauses;	// clauses[id] (NULL if unused or deleted)
+	bool			contradiction;
+
+	bool _inRange( Clause c ) const;
+	void _assign( Literal l );
+	bool _propagate( const int* hints );
+	void _reset();
+};
+
+#endif
@@ -1,30 +1,124 @@
 #include <iostream>
+#include <vector>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 #include "parser.h"
 #include "solver.h"
+#include "lrat.h"
+#include "input.h"
 
-int do_rup( FILE* input_file, FILE* proof_file )
+// command-line options
+static int	num_jobs = 1;		// number of segment workers (-j)
+static int	segment_len = 0;	// lemmas per segment (-n), 0 = auto
+static double	sample_rate = 1.0;	// fraction of lemmas to verify (-p)
+static double	check_budget = 0;	// verified lemmas per second (-r), 0 = off
+static double	confidence = 0.95;	// confidence level to report (-c)
+static long	sample_seed = 1;	// random seed for sampling (-s)
+static bool	lrat_proof = false;	// the proof is in LRAT format (-l)
+static bool	follow_proof = false;	// wait for a growing proof file (-f)
+static int	follow_idle = 60;	// give up after idle seconds (-w)
+
+static bool sampling() { return sample_rate < 1.0 || check_budget > 0; }
+
+static double elapsed_seconds( const struct timeval& start )
+{
+	struct timeval	now;
+	gettimeofday( &now, NULL );
+	return (now.tv_sec - start.tv_sec) + (now.tv_usec - start.tv_usec) * 1e-6;
+}
+
+/* Prints how much of the proof was verified. If every sampled lemma passed,
+ * then with the given confidence fewer than the reported fraction of all
+ * lemmas are invalid: (1-eps)^k = 1-confidence for k uniform samples.
+ * The counts leave out the empty clause, which is always checked.
+ * The budget (-r) picks lemmas by timing, not at random, so no bound is
+ * given then. */
+static void print_sample_stat( int num_checked, int num_lemmas, bool success )
+{
+	clog << "verified " << num_checked << " of " << num_lemmas << " lemmas";
+	if( success && check_budget <= 0
+		&& num_checked > 0 && num_checked < num_lemmas ) {
+		double	eps = 1.0 - pow( 1.0 - confidence, 1.0 / num_checked );
+		clog << "; at " << confidence * 100 << "% confidence fewer than "
+			 << eps * 100 << "% of lemmas are invalid";
+	}
+	clog << endl;
+}
+
+/* Prints the result, but only once every input turned out to be read
+ * completely and without errors. */
+static int report( bool success, bool sampled=false )
+{
+	if( !close_inputs() ) {
+		clog << "Error reading compressed input" << endl;
+		return 2;
+	}
+	if( success && sampled )	// not to be mistaken for a full check
+		cout << "OK (sampled)" << endl;
+	else
+		cout << (success? "OK": "FAIL") << endl;
+	return success? 0: 1;
+}
+
+static Solver* load_benchmark( FILE* input_file )
 {
 	Parser in(input_file);
-    
+
 	int num_vars, num_cl;
 	int **cl;
-    
+
 	cl = in.sat_benchmark(num_vars, num_cl);
-    
+
 	// Constructing solver
 	Solver* 	s = new Solver( num_vars );
-    
+
 	for( int** it=cl; *it; it++ )
  		s->assert( *it );
+	delete[] cl;
+	return s;
+}
+
+int do_rup( FILE* input_file, FILE* proof_file )
+{
+	Solver* 	s = load_benchmark( input_file );
 
 	Parser pf(proof_file);
+	if( follow_proof )
+		pf.follow( follow_idle * 1000 );
 
 	bool    success = false;
-	
+
+	// sampling mode: unsampled lemmas are added without checking
+	// (the counts leave out the empty clause, which is always checked)
+	int				num_lemmas = 0, num_checked = 0;
+	struct timeval	start;
+	gettimeofday( &start, NULL );
+	srand48( sample_seed );
+
 	while( !feof(proof_file) )
 	{
 		Clause	c;
 		c = pf.parse_clause();
+		if( c == NULL )	// end of proof without the empty clause
+			break;
+		bool	verify = true;
+		if( sampling() && c[0] != 0 ) {	// always check the empty clause
+			num_lemmas++;
+			verify = drand48() < sample_rate;
+			if( verify && check_budget > 0 )
+				verify = num_checked < check_budget * elapsed_seconds( start );
+			if( verify )
+				num_checked++;
+		}
+		if( !verify ) {
+			s->assert( c );
+			continue;
+		}
         //clog << "check" << endl;
         bool	ok = s->check( c );
         if( !ok )	// check failed
@@ -34,26 +128,275 @@ int do_rup( FILE* input_file, FILE* proof_file )
             break;
 		}
 	}
-	if( success ) {
-		cout << "OK" << endl;
-		return 0;
+	if( sampling() )
+		print_sample_stat( num_checked, num_lemmas, success );
+	return report( success, sampling() && num_checked < num_lemmas );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// segment-parallel checking
+
+/* Checks lemmas[begin..end) on the given solver state.
+ * Returns the index of the first failing lemma, or -1 if all passed. */
+static int check_segment( Solver* s, const vector<Clause>& lemmas,
+						  int begin, int end )
+{
+	for( int i=begin; i<end; i++ ) {
+		if( !s->check( lemmas[i] ) )
+			return i;
 	}
-	else {
-		cout << "FAIL" << endl;
-		return 1;
+	return -1;
+}
+
+struct Worker {
+	pid_t	pid;
+	int		fd;		// read end of the result pipe
+	int		begin;	// first lemma of the segment
+};
+
+// waits for a worker and returns its first failing lemma (-1 if none)
+static int reap_worker( const Worker& w )
+{
+	int	result;
+	if( read( w.fd, &result, sizeof(result) ) != sizeof(result) )
+		result = w.begin;	// worker died without reporting -> blame it
+	close( w.fd );
+	int	status;
+	waitpid( w.pid, &status, 0 );
+	return result;
+}
+
+/* A fast trusting pass adds every lemma to the clause database without
+ * checking it. Every segment_len lemmas, the current state is snapshotted
+ * by fork() (copy-on-write), and the child checks the next segment with
+ * check() while the parent moves on. */
+int do_rup_parallel( FILE* input_file, FILE* proof_file )
+{
+	Solver* 	s = load_benchmark( input_file );
+
+	// read the whole proof up to the empty clause
+	Parser			pf(proof_file);
+	vector<Clause>	lemmas;
+	while( !feof(proof_file) )
+	{
+		Clause	c = pf.parse_clause();
+		if( c == NULL )	// end of proof without the empty clause
+			break;
+		lemmas.push_back( c );
+		if( c[0] == 0 )
+			break;
+	}
+	int		num_lemmas = lemmas.size();
+	bool	has_empty = num_lemmas > 0 && lemmas.back()[0] == 0;
+
+	int		n = segment_len;
+	if( n <= 0 )
+		n = (num_lemmas + num_jobs - 1) / num_jobs;
+	if( n <= 0 )
+		n = 1;
+
+	fflush( stdout );
+	vector<Worker>	workers;
+	size_t			next_reap = 0;
+	int				failed = -1;
+	for( int begin=0; begin<num_lemmas && failed<0; begin+=n )
+	{
+		int	end = min( begin+n, num_lemmas );
+
+		// limit the number of running workers
+		if( (int)(workers.size() - next_reap) >= num_jobs )
+			failed = reap_worker( workers[next_reap++] );
+		if( failed >= 0 )
+			break;
+
+		int	fds[2];
+		if( pipe( fds ) != 0 ) {
+			perror( "pipe" );
+			exit( 2 );
+		}
+		pid_t	pid = fork();
+		if( pid < 0 ) {
+			perror( "fork" );
+			exit( 2 );
+		}
+		if( pid == 0 ) {	// worker: check the segment on the snapshot
+			close( fds[0] );
+			int	result = check_segment( s, lemmas, begin, end );
+			if( write( fds[1], &result, sizeof(result) ) != sizeof(result) )
+				_exit( 2 );
+			_exit( 0 );
+		}
+		close( fds[1] );
+		Worker	w = { pid, fds[0], begin };
+		workers.push_back( w );
+
+		// advance the snapshot past the segment without checking
+		for( int i=begin; i<end; i++ )
+			s->assert( lemmas[i] );
 	}
+
+	// combine results in proof order
+	for( ; next_reap<workers.size(); next_reap++ )
+	{
+		if( failed >= 0 ) {	// later segments don't matter any more
+			kill( workers[next_reap].pid, SIGTERM );
+			reap_worker( workers[next_reap] );
+			continue;
+		}
+		failed = reap_worker( workers[next_reap] );
+	}
+
+	if( failed >= 0 )
+		clog << "lemma " << failed+1 << " failed" << endl;
+	return report( failed < 0 && has_empty );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// hint-guided checking
+
+int do_lrat( FILE* input_file, FILE* proof_file )
+{
+	Parser in(input_file);
+
+	int num_vars, num_cl;
+	int **cl;
+
+	cl = in.sat_benchmark(num_vars, num_cl);
+
+	LratChecker*	s = new LratChecker( num_vars );
+
+	for( int** it=cl; *it; it++ )
+	{
+		if( !s->addOriginal( *it ) ) {
+			clog << "input clause " << it-cl+1
+				 << " has a variable out of range" << endl;
+			return report( false );
+		}
+	}
+
+	Parser pf(proof_file);
+	if( follow_proof )
+		pf.follow( follow_idle * 1000 );
+
+	int		id, lemma = 0;
+	int*	lits;
+	int*	hints;
+	bool	ok = true;
+	while( !s->isContradicted() && pf.parse_lrat( id, lits, hints ) )
+	{
+		if( lits == NULL ) {	// deletion
+			for( int* it=hints; *it; it++ )
+				s->remove( *it );
+			delete[] hints;
+			continue;
+		}
+		lemma++;
+		ok = s->check( id, lits, hints );
+		delete[] hints;
+		if( !ok ) {
+			clog << "lemma " << lemma << " (id " << id << ") failed" << endl;
+			delete[] lits;
+			break;
+		}
+	}
+	return report( ok && s->isContradicted() );
+}
+
+static void usage( const char* prog )
+{
+	clog << "usage: " << prog
+		 << " [-j jobs] [-n lemmas] [-p rate] [-r lemmas/sec] [-s seed]"
+		 << " [-c confidence] [-l] [-f] [-w secs]"
+		 << " <input.cnf> [proof]" << endl
+		 << "  -j jobs    check proof segments in parallel with jobs workers"
+		 << endl
+		 << "  -n lemmas  number of lemmas per segment (default: even split)"
+		 << endl
+		 << "  -p rate    verify only a random fraction of the lemmas" << endl
+		 << "  -r num     verify at most num lemmas per second" << endl
+		 << "  -s seed    random seed for -p (default: 1)" << endl
+		 << "  -c conf    confidence level reported for -p/-r (default: 0.95)"
+		 << endl
+		 << "  -l         the proof is in LRAT format (text or binary)" << endl
+		 << "  -f         follow a proof file that is still being written" << endl
+		 << "  -w secs    with -f, give up after secs without growth (default: 60)"
+		 << endl;
 }
 
 int main( int argc, char** argv )
 {
+    const char*	prog = argv[0];
+    int	opt;
+    while( (opt = getopt( argc, argv, "j:n:p:r:s:c:lfw:" )) != -1 ) {
+        switch( opt ) {
+        case 'j':
+            num_jobs = atoi( optarg );
+            break;
+        case 'n':
+            segment_len = atoi( optarg );
+            break;
+        case 'p':
+            sample_rate = atof( optarg );
+            break;
+        case 'r':
+            check_budget = atof( optarg );
+            break;
+        case 's':
+            sample_seed = atol( optarg );
+            break;
+        case 'c':
+            confidence = atof( optarg );
+            break;
+        case 'l':
+            lrat_proof = true;
+            break;
+        case 'f':
+            follow_proof = true;
+            break;
+        case 'w':
+            follow_idle = atoi( optarg );
+            break;
+        default:
+            usage( prog );
+            return 2;
+        }
+    }
+    argc -= optind - 1;
+    argv += optind - 1;
     if( argc < 2 || argc > 3 ) {
         clog << "Invalid number of arguments" << endl;
+        usage( prog );
+        return 2;
+    }
+    if( num_jobs < 1 || sample_rate < 0 || sample_rate > 1
+        || confidence <= 0 || confidence >= 1
+        || follow_idle < 0 || follow_idle > INT_MAX / 1000 ) {
+        clog << "Invalid option value" << endl;
+        usage( prog );
+        return 2;
+    }
+    FILE* in = open_input( argv[1] );
+    FILE* pf = open_input( argc == 3? argv[2]: NULL );
+    if( in == NULL || pf == NULL ) {
+        perror( in == NULL? argv[1]: argv[2] );
+        return 2;
+    }
+    if( follow_proof && (num_jobs > 1 || segment_len > 0) ) {
+        // segments are forked only after the whole proof is read
+        clog << "Follow mode cannot be combined with -j/-n" << endl;
+        return 2;
+    }
+    if( lrat_proof && (sampling() || num_jobs > 1 || segment_len > 0) ) {
+        clog << "LRAT checking cannot be combined with -p/-r or -j/-n" << endl;
+        return 2;
+    }
+    if( lrat_proof )
+        return do_lrat( in, pf );
+    if( sampling() && (num_jobs > 1 || segment_len > 0) ) {
+        clog << "Sampling cannot be combined with parallel checking" << endl;
         return 2;
     }
-    FILE* pf;
-    if( argc == 3 )
-        pf = fopen( argv[2], "r" );
-    else
-        pf = stdin;
-	return do_rup( fopen(argv[1],"r"), pf );
+    if( num_jobs > 1 || segment_len > 0 )
+        return do_rup_parallel( in, pf );
+    return do_rup( in, pf );
 }
@@ -1,6 +1,29 @@
 #include "parser.h"
+#include "input.h"
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const int FOLLOW_POLL_MS = 50;
+
+void Parser::follow(int idle_ms) {
+  struct stat st;
+  if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode))
+    follow_ms = idle_ms;
+}
+
+int Parser::readc() {
+  int c = fgetc(f);
+  // the writer may be in the middle of a line, so just keep reading
+  for (int idle = 0; c == EOF && idle < follow_ms; idle += FOLLOW_POLL_MS) {
+    usleep(FOLLOW_POLL_MS * 1000);
+    clearerr(f);
+    c = fgetc(f);
+  }
+  return c;
+}
 
 void Parser::ogetc_push(char c) {
   if (ogetc_c != 0)
@@ -17,20 +40,22 @@ char Parser::ogetc() {
     ogetc_c = 0;
   }
   else
-    c = fgetc(f);
+    c = readc();
   if (c == '\n')
     linenum++;
   return c;
 }
 
 void Parser::consume_line() {
-  while (fgetc(f) != '\n');
+  int c;
+  while ((c = readc()) != '\n' && c != EOF);
   linenum++;
 }      
 
 void Parser::error(const char *msg) {
   printf("Error on line %d: %s\n",linenum, msg);
-  exit(1);
+  // a failed decompressor is the real cause of a short or garbled stream
+  exit(close_inputs() ? 1 : 2);
 }
 
 int Parser::isspace(char c) {
@@ -73,6 +98,10 @@ int *Parser::clause() {
   int i = 0;
   while(true) {
     eatws();
+    char c = ogetc();
+    if (c == (char)EOF) // only a literal 0 ends a clause
+      error("Unexpected end of file in a clause.");
+    ogetc_push(c);
     if ((buf[i++] = oint()) == 0) {
       int *c = new int[i];
       for (int j = 0; j < i; j++)
@@ -122,5 +151,90 @@ int **Parser::sat_benchmark(int &num_vars, int &num_cl) {
 int* Parser::parse_clause()
 {
 	eatws();
+	char c = ogetc();
+	if (c == (char)EOF)	// no more lemmas
+		return 0;
+	ogetc_push(c);
 	return clause();
 }
+
+int Parser::bint(bool lit) {
+  unsigned x = 0;
+  int shift = 0;
+  int c;
+  do {
+    if ((c = readc()) == EOF)
+      error("Unexpected end of file in binary LRAT.");
+    // at most 32 bits: four full groups and 4 bits of the fifth
+    if (shift > 28 || (shift == 28 && (c & 0x7f) > 0xf))
+      error("Overflow occurred reading a binary LRAT number.");
+    x |= (unsigned)(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  if (!lit) {
+    if (x > INT_MAX)
+      error("Overflow occurred reading a binary LRAT number.");
+    return (int)x;
+  }
+  // literals are encoded as 2*var + sign
+  return (x & 1) ? -(int)(x >> 1) : (int)(x >> 1);
+}
+
+int *Parser::bclause() {
+  int i = 0;
+  while(true) {
+    if ((buf[i++] = bint(true)) == 0) {
+      int *c = new int[i];
+      for (int j = 0; j < i; j++)
+	c[j] = buf[j];
+      return c;
+    }
+    if (i == BUFLEN)
+      error("Maximum clause length exceeded.");
+  }
+  return 0; // never reached
+}
+
+bool Parser::parse_lrat(int &id, int *&lits, int *&hints) {
+  char c;
+  if (!binary) {
+    while ((c = ogetc()) == 'c' || isspace(c))
+      if (c == 'c')
+        consume_line();
+    if (c == 'a' || c == 'd') // text steps start with a digit
+      binary = true;
+    ogetc_push(c);
+  }
+  if (binary) {
+    int t = ogetc_c ? ogetc_c : readc();
+    ogetc_c = 0;
+    if (t == EOF)
+      return false;
+    if (t == 'a') {
+      id = bint(true);
+      lits = bclause();
+    }
+    else if (t == 'd') { // binary deletions have no step id
+      id = 0;
+      lits = 0;
+    }
+    else
+      error("Expected 'a' or 'd' in binary LRAT.");
+    hints = bclause();
+    return true;
+  }
+  if ((c = ogetc()) == (char)EOF)
+    return false;
+  ogetc_push(c);
+  id = oint();
+  eatws();
+  if ((c = ogetc()) == 'd')
+    lits = 0;
+  else {
+    ogetc_push(c);
+    lits = clause();
+  }
+  eatws();
+  hints = clause();
+  return true;
+}
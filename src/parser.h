@@ -15,6 +15,13 @@ protected:
     void ogetc_push(char c); // push back a char we read
     int oint(bool neg = false, bool eat_follow = true); // read int
     int *clause();
+    int *bclause(); // read a 0-terminated list in binary LRAT
+    int bint(bool lit); // read a binary LRAT number
+
+    bool binary; // binary LRAT detected
+    int follow_ms; // wait this long for a growing file at EOF (0 = don't)
+
+    int readc(); // read a byte from the file, waiting for more in follow mode
     
     void eatws(); // consume whitespace
     void consume_line(); // read until end of line
@@ -28,7 +35,12 @@ protected:
     void print(FILE *o, int *clause);
     
 public:
-    Parser(FILE *_f) : f(_f), linenum(1), ogetc_c(0), buf() {}
+    Parser(FILE *_f) : f(_f), linenum(1), ogetc_c(0), buf(), binary(false),
+                        follow_ms(0) {}
+
+    // treat EOF on a regular file as "wait for more", giving up after
+    // the file has not grown for idle_ms milliseconds
+    void follow(int idle_ms);
     
     // parse a benchmark
     int **sat_benchmark(int &num_vars, int &num_cl);
@@ -37,7 +49,12 @@ public:
     void print(FILE *o, int **bench);
 	
 	// RUP support
-    int* parse_clause();
+    int* parse_clause(); // returns NULL at end of file
+
+    // LRAT support (text or binary, detected from the first step)
+    // reads one step; lits is NULL for a deletion, hints holds the
+    // antecedent ids (or the deleted ids). returns false at end of file.
+    bool parse_lrat(int &id, int *&lits, int *&hints);
 };
 
 #endif
@@ -5,6 +5,7 @@
 #include <iostream>
 #include <list>
 #include <stdlib.h>
+#include <string.h>
 
 using namespace std;
 
@@ -68,6 +69,7 @@ Solver::Solver( unsigned _num_vars )
 
 	debugMode = false;
 	verboseMode = false;
+	compaction = true;
 
 	pa = new char[num_vars+1];
 	fill( pa, pa+num_vars+1, UN );
@@ -77,12 +79,21 @@ Solver::Solver( unsigned _num_vars )
 
 	dls = new int[num_vars+1];
 	dl = 0;
+	contradiction = false;
 
 	assignHistory = new Literal[num_vars+1];	// including null terminator
 	assignHistoryEnd = assignHistory;
 	
 	numAssignments = 0;
 	numConflicts = 0;
+	numCompactions = 0;
+
+	arena = NULL;
+	arenaLits = 0;
+	dbLits = 0;
+	recentClauses = new Clause[RECENT_SIZE];
+	fill( recentClauses, recentClauses+RECENT_SIZE, (Clause)NULL );
+	recentPos = 0;
 
 	initWatch();
 }
@@ -107,18 +118,40 @@ inline bool isFalsified( const char* pa, Literal lit ) {
 	int	var = abs(lit);
 	return (pa[var] == getNegSign(lit));
 }
+// true if it is past the last literal of c, which has N literals (N > 0)
+// or is null-terminated (N == 0)
+template<int N>
+inline bool clauseEnd( const Literal* c, const Literal* it ) {
+	return N? it == c+N: *it == 0;
+}
 
-void Solver::_addWatchedLiteral( Literal l, Clause c )
+Solver::WatchList& Solver::_watchList( Literal l, int len )
 {
-	int			var = abs( l );
-	WatchList&	wl = l>0? posLitWatches[var]: negLitWatches[var];
-	wl.push_back( c );
+	int	var = abs( l );
+	if( len == 0 )
+		return l>0? posLitWatches[var]: negLitWatches[var];
+	return l>0? posShortWatches[len][var]: negShortWatches[len][var];
 }
 
-void Solver::_removeWatchedLiteral( Literal l, Clause c )
+// the length of a clause, or 0 if it is longer than MAX_SHORT_LEN
+int Solver::_watchLength( Clause c )
 {
-	int			var = abs( l );
-	WatchList&	wl = l>0? posLitWatches[var]: negLitWatches[var];
+	for( int len=0; len<=MAX_SHORT_LEN; len++ )
+	{
+		if( c[len] == 0 )
+			return len;
+	}
+	return 0;
+}
+
+void Solver::_addWatchedLiteral( Literal l, Clause c, int len )
+{
+	_watchList( l, len ).push_back( c );
+}
+
+void Solver::_removeWatchedLiteral( Literal l, Clause c, int len )
+{
+	WatchList&	wl = _watchList( l, len );
 	for( WatchList::iterator it=wl.begin(); it!=wl.end(); it++ )
 	{
 		if( *it == c ) {
@@ -140,6 +173,17 @@ void Solver::_addImpLiterals( Literal one, Literal the_other, Clause c )
 	l2.push_back( make_pair(c,one) );
 }
 
+void Solver::_addTernLiterals( Clause c )
+{
+	for( int i=0; i<3; i++ )
+	{
+		int			var = abs( c[i] );
+		TernList&	tl = c[i]>0? posTernLists[var]: negTernLists[var];
+		TernImp		t = { c, c[(i+1)%3], c[(i+2)%3] };
+		tl.push_back( t );
+	}
+}
+
 void Solver::_addWatchedClause( Clause c )
 {
 	// assume the clause is not a empty or unit clause
@@ -196,10 +240,15 @@ void Solver::_addWatchedClause( Clause c )
 	{
 		_addImpLiterals( c[0], c[1], c );
 	}
+	else if( c[3] == 0 )	// ternary clause
+	{
+		_addTernLiterals( c );
+	}
 	else
 	{
-		_addWatchedLiteral( c[0], c );	// should be unassiged
-		_addWatchedLiteral( c[1], c );	// unassigned or falsified
+		int	wlen = _watchLength( c );
+		_addWatchedLiteral( c[0], c, wlen );	// should be unassiged
+		_addWatchedLiteral( c[1], c, wlen );	// unassigned or falsified
 	}
 }
 
@@ -223,6 +272,14 @@ void Solver::initWatch()
 	negLitWatches = new WatchList[num_vars+1];
 	posImpLists = new ImpList[num_vars+1];	// [0] is not used
 	negImpLists = new ImpList[num_vars+1];
+	posTernLists = new TernList[num_vars+1];	// [0] is not used
+	negTernLists = new TernList[num_vars+1];
+	for( int len=0; len<=MAX_SHORT_LEN; len++ )
+	{
+		bool	used = len >= 4;
+		posShortWatches[len] = used? new WatchList[num_vars+1]: NULL;
+		negShortWatches[len] = used? new WatchList[num_vars+1]: NULL;
+	}
 }
 
 void Solver::addNewWatchedClause( Clause c )
@@ -262,8 +319,54 @@ Clause Solver::propagateLiteral( Literal l, Literal* output_it )
 		}
 	}
 
-	// for general watched list
-	WatchList&	wl = (falsified > 0)? posLitWatches[var]: negLitWatches[var];
+	// for ternary list
+	TernList&	tl = (falsified > 0)? posTernLists[var]: negTernLists[var];
+	for( unsigned index=0; index<tl.size(); index++ )
+	{
+		const TernImp&	t = tl[index];
+		char	val1 = pa[abs(t.first)];
+		char	val2 = pa[abs(t.second)];
+		if( val1 == getSign(t.first) || val2 == getSign(t.second) )
+			continue;	// SAT -> ignore
+		Literal	unit;
+		if( val1 == UN ) {
+			if( val2 == UN )	// two free lits -> undetermined
+				continue;
+			unit = t.first;
+		}
+		else if( val2 == UN )
+			unit = t.second;
+		else {	// no unassigned lits -> conflict
+			*output_it = 0;
+			return t.c;
+		}
+		int	unit_var = abs( unit );
+		if( why[unit_var] == NULL ) {	// see if it's not in the pipeline
+			why[unit_var] = t.c;
+			*output_it++ = unit;
+		}
+	}
+
+	// for watched lists, shortest clauses first
+	Clause	cc;
+	if( (cc = _propagateWatches<4>( falsified, output_it )) != NULL
+		|| (cc = _propagateWatches<5>( falsified, output_it )) != NULL
+		|| (cc = _propagateWatches<6>( falsified, output_it )) != NULL
+		|| (cc = _propagateWatches<7>( falsified, output_it )) != NULL
+		|| (cc = _propagateWatches<8>( falsified, output_it )) != NULL
+		|| (cc = _propagateWatches<0>( falsified, output_it )) != NULL )
+		return cc;
+	*output_it = 0;
+	return NULL;	// no conflict
+}
+
+/* Scans the watch list of the falsified literal for clauses of length N
+ * (or of any longer length if N is 0). With N fixed, the search for a
+ * replacement watch runs to a constant bound instead of the terminator. */
+template<int N>
+Clause Solver::_propagateWatches( Literal falsified, Literal*& output_it )
+{
+	WatchList&	wl = _watchList( falsified, N );
 	for( unsigned index=0; index<wl.size(); index++ )
 	{
 		Clause	c = wl[index];
@@ -277,8 +380,9 @@ Clause Solver::propagateLiteral( Literal l, Literal* output_it )
 			// let's find another unassinged lit in the clause
 			Literal		unassigned = 0;
 			Literal*	it2 = c + 2;
-			for( int l; (l=*it2); it2++ )
+			for( ; !clauseEnd<N>(c,it2); it2++ )
 			{
+				Literal	l = *it2;
 				char	val = pa[abs(l)];
 				if( val == getSign(l) )
 					break;
@@ -287,7 +391,7 @@ Clause Solver::propagateLiteral( Literal l, Literal* output_it )
 					break;
 				}
 			}
-			if( *it2 == 0 )	// if we got a unit clause
+			if( clauseEnd<N>(c,it2) )	// if we got a unit clause
 			{
 				int	unit_var = abs( the_other );
 				if( why[unit_var] == NULL ) {	// see if it's not in the pipeline
@@ -305,7 +409,7 @@ Clause Solver::propagateLiteral( Literal l, Literal* output_it )
 			//wl.erase( wl.begin()+index ); index--;	// slow
 			wl[index--] = wl.back(), wl.pop_back();		// fast remove
 
-			_addWatchedLiteral( *it2, c );
+			_addWatchedLiteral( *it2, c, N );
 			if( c[0] == falsified )
 				swap( c[0], *it2 );
 			else
@@ -314,38 +418,40 @@ Clause Solver::propagateLiteral( Literal l, Literal* output_it )
 		else	// the other is falsified
 		{
 			// let's find an unassinged lit in the clause
+			// (one value load per lit: SAT or UN both stop the search)
 			Literal*	it2 = c + 2;
-			for( ; *it2; it2++ ) {
-				if( isSatisfied(pa,*it2) )
-					break;
-				if( isUnassigned(pa,*it2) )
+			char		val2 = FF;
+			for( ; !clauseEnd<N>(c,it2); it2++ ) {
+				Literal	l = *it2;
+				val2 = pa[abs(l)];
+				if( val2 != getNegSign(l) )
 					break;
 			}
-			if( *it2 == 0 ) {	// no unassigned lits -> conflict
+			if( clauseEnd<N>(c,it2) ) {	// no unassigned lits -> conflict
 				*output_it = 0;
 				return c;
 			}
-			if( isSatisfied(pa,*it2) )	// we got a satisfied clause
+			if( val2 != UN )	// we got a satisfied clause
 				continue;
 
 			// yes, we got one
 			//_removeWatchedLiteral( falsified, cn );	// unsafe
 			//wl.erase( wl.begin()+index ); index--;	// slow
 			wl[index--] = wl.back(), wl.pop_back();		// fast remove
-			_addWatchedLiteral( *it2, c );
+			_addWatchedLiteral( *it2, c, N );
 			if( c[0] == falsified )
 				swap( c[0], *it2 );
 			else
 				swap( c[1], *it2 );
 
 			// try to find one more
-			for( ; *it2; it2++ ) {
-				if( isSatisfied(pa,*it2) )
-					break;
-				if( isUnassigned(pa,*it2) )
+			for( ; !clauseEnd<N>(c,it2); it2++ ) {
+				Literal	l = *it2;
+				val2 = pa[abs(l)];
+				if( val2 != getNegSign(l) )
 					break;
 			}
-			if( *it2 == 0 )	// if we got a unit clause
+			if( clauseEnd<N>(c,it2) )	// if we got a unit clause
 			{
 				int	unit_var = abs( c[0] );
 				if( why[unit_var] == NULL ) {	// see if it's not in the pipeline
@@ -354,20 +460,116 @@ Clause Solver::propagateLiteral( Literal l, Literal* output_it )
 				}
 				continue;
 			}
-			if( isSatisfied(pa,*it2) )	// we got a satisfied clause
+			if( val2 != UN )	// we got a satisfied clause
 				continue;
 
 			// two unassigned lits -> undetermined
-			_removeWatchedLiteral( the_other, c );
-			_addWatchedLiteral( *it2, c );
+			_removeWatchedLiteral( the_other, c, N );
+			_addWatchedLiteral( *it2, c, N );
 			if( c[0] == the_other )
 				swap( c[0], *it2 );
 			else
 				swap( c[1], *it2 );
 		}
 	}
-	*output_it = 0;
-	return NULL;	// no conflict
+	return NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// clause relocation
+
+/* Copies c to dest (once) and returns the new location. The old clause
+ * is overwritten with a forwarding pointer: a 0 literal followed by the
+ * new address. Unit clauses are only referenced from why[], so they are
+ * never visited twice (and are too short to hold a pointer). */
+Clause Solver::_relocate( Clause c, Literal*& dest, vector<Clause>& garbage )
+{
+	if( c[0] == 0 ) {	// already relocated
+		Clause	to;
+		memcpy( &to, c+1, sizeof(to) );
+		return to;
+	}
+	Clause		to = dest;
+	Literal*	it = c;
+	while( *it )
+		*dest++ = *it++;
+	*dest++ = 0;
+	if( it - c >= 2 ) {
+		c[0] = 0;
+		memcpy( c+1, &to, sizeof(to) );
+	}
+	if( !_inArena( c ) )
+		garbage.push_back( c );
+	return to;
+}
+
+void Solver::_relocateWatches( Literal l, Literal*& dest,
+							   vector<Clause>& garbage )
+{
+	int			var = abs( l );
+	ImpList&	il = l>0? posImpLists[var]: negImpLists[var];
+	for( unsigned i=0; i<il.size(); i++ )
+		il[i].first = _relocate( il[i].first, dest, garbage );
+	TernList&	tl = l>0? posTernLists[var]: negTernLists[var];
+	for( unsigned i=0; i<tl.size(); i++ )
+		tl[i].c = _relocate( tl[i].c, dest, garbage );
+	// short clauses first, as propagateLiteral() visits them
+	for( int len=4; len<=MAX_SHORT_LEN+1; len++ )
+	{
+		WatchList&	wl = _watchList( l, len>MAX_SHORT_LEN? 0: len );
+		for( unsigned i=0; i<wl.size(); i++ )
+			wl[i] = _relocate( wl[i], dest, garbage );
+	}
+}
+
+void Solver::compact()
+{
+	PROGRESS( "compacting %lu clause literals\n", (unsigned long)dbLits );
+	Literal*		new_arena = new Literal[dbLits];
+	Literal*		dest = new_arena;
+	vector<Clause>	garbage;
+
+	// clauses that propagated or conflicted most recently first
+	for( unsigned i=1; i<=RECENT_SIZE; i++ )
+	{
+		Clause&	c = recentClauses[(recentPos - i) & (RECENT_SIZE-1)];
+		if( c != NULL )
+			c = _relocate( c, dest, garbage );
+	}
+
+	// then each literal's lists in the order propagation visits them
+	for( int v=1; v<=(int)num_vars; v++ )
+	{
+		_relocateWatches( v, dest, garbage );
+		_relocateWatches( -v, dest, garbage );
+	}
+
+	// level-0 reasons are never visited again, but must be kept up to date
+	// (unit clauses only live here)
+	for( int v=1; v<=(int)num_vars; v++ )
+	{
+		if( why[v] != NULL )
+			why[v] = _relocate( why[v], dest, garbage );
+	}
+	ASSERT( (size_t)(dest - new_arena) == dbLits );
+
+	for( size_t i=0; i<garbage.size(); i++ )
+		delete[] garbage[i];
+	delete[] arena;
+	arena = new_arena;
+	arenaLits = dest - new_arena;
+	numCompactions++;
+}
+
+// compacts when more than half of the clause database is outside the arena
+void Solver::_maybeCompact()
+{
+	if( !compaction || contradiction )
+		return;
+	size_t	scattered = dbLits - arenaLits;
+	if( scattered > MIN_COMPACT_LITS && scattered > arenaLits )
+		compact();
 }
 
 
@@ -432,6 +634,7 @@ Clause Solver::_assertLiteral( Literal l, Clause reason )
 			pa[v] = getSign( l );
 			dls[v] = dl;
 			numAssignments++;
+			_touch( why[v] );
 			TRACE( "   assign by UP: %d for #%d\n", l, why[v] );
 		}
 	}
@@ -449,6 +652,7 @@ bool Solver::assertLiteral( Literal l, Clause reason, Clause& cc )
 	{
 		TRACE( "    detected a conflict with #%d\n", result );
 		numConflicts++;
+		_touch( result );
 		cc = result;
 		return false;
 	}
@@ -500,9 +704,16 @@ void Solver::learn( Clause c )
 	Literal	lit;
 	int		num_free;
 	num_free = countFreeLits( c, lit );
-	
+
+	if( num_free > 0 ) {	// c becomes part of the clause database
+		Literal*	it = c;
+		while( *it++ ) ;
+		dbLits += it - c;
+	}
+
 	if( num_free == 0 ) {	// if empty
 		TRACE( "  observed contradiction\n" );
+		contradiction = true;
 	}
 	else if( num_free == 1 )	// if unit
 	{
@@ -510,6 +721,7 @@ void Solver::learn( Clause c )
 		bool	ok = assertLiteral( lit, c, cc );
 		if( !ok ) {
 			TRACE( "  observed contradiction\n" );
+			contradiction = true;
 		}
 	}
 	else {
@@ -538,6 +750,9 @@ bool Solver::hypothesize( Clause c )
 
 void Solver::assert( Clause c )
 {
+	if( contradiction )	// everything follows from a contradiction
+		return;
+	_maybeCompact();
 	if( checkSat( c ) )
 		return;
 	learn( c );
@@ -545,6 +760,10 @@ void Solver::assert( Clause c )
 
 bool Solver::check( Clause c )
 {
+	if( contradiction )	// everything follows from a contradiction
+		return true;
+	_maybeCompact();
+
 	dl = 1;
 
 	bool	ok = hypothesize( c );
@@ -552,7 +771,8 @@ bool Solver::check( Clause c )
 		return false;
 	
 	backjump( 0 );
-	learn( c );
+	if( !checkSat( c ) )	// learn() assumes c is not satisfied
+		learn( c );
 	return true;
 }
 
@@ -562,6 +782,6 @@ bool Solver::check( Clause c )
 
 void Solver::printStat( FILE* o )
 {
-	fprintf( o, "%d assignments, %d conflicts\n",
-			 numAssignments, numConflicts );
+	fprintf( o, "%d assignments, %d conflicts, %d compactions\n",
+			 numAssignments, numConflicts, numCompactions );
 }
@@ -26,8 +26,16 @@ public:	// public interface
 	void setDebugMode( bool flag=true ) { debugMode = flag; }
 	void setVerboseMode( bool flag=true ) { verboseMode = flag; }
 
+	/* With compaction on (the default), the solver owns the clauses added
+	 * to it: they must be allocated with new[] and may be moved and freed.
+	 * Turn it off for clauses that are not allocated that way. */
+	void setCompaction( bool flag=true ) { compaction = flag; }
+
 	void assert( Clause c );
 	bool check( Clause c );
+
+	// true once the clause database is known to be contradictory
+	bool isContradicted() const { return contradiction; }
 	
 	void printStat( FILE* o );
 	
@@ -37,6 +45,7 @@ protected:	// given settings
 	// options
 	bool	debugMode;
 	bool	verboseMode;
+	bool	compaction;
 
 protected:	// solver states
 	// variable assignment states (be careful that variable zero is not used)
@@ -45,6 +54,7 @@ protected:	// solver states
 					and NULL if i was a decision var. */
 	int*	dls; // dls[i] = l if i's value was set at decision level l.
 	int		dl; // current decision level
+	bool	contradiction; // a conflict was observed at level 0
 
 	// history of current partial assignment
 	Literal*	assignHistory;		// array of literals in assigned order
@@ -53,6 +63,7 @@ protected:	// solver states
 	// stats
 	unsigned int	numAssignments;
 	unsigned int	numConflicts;
+	unsigned int	numCompactions;
 
 protected:	// watched literals
 	typedef	vector<Clause>	WatchList;	// an array of clauses
@@ -63,15 +74,60 @@ protected:	// watched literals
 	ImpList*	posImpLists;
 	ImpList*	negImpLists;
 
-	void _addWatchedLiteral( Literal l, Clause c );
-	void _removeWatchedLiteral( Literal l, Clause c );
+	// ternary clauses are kept in all three literals' lists (no watches)
+	struct TernImp { Clause c; Literal first, second; };
+	typedef vector<TernImp>	TernList;
+	TernList*	posTernLists;
+	TernList*	negTernLists;
+
+	/* clauses of 4..MAX_SHORT_LEN literals are watched in lists of their
+	 * own length, so that propagation can scan them with a fixed-length
+	 * loop. Longer clauses are kept in posLitWatches/negLitWatches. */
+	static const int	MAX_SHORT_LEN = 8;
+	WatchList*	posShortWatches[MAX_SHORT_LEN+1];	// [len], [4..] used
+	WatchList*	negShortWatches[MAX_SHORT_LEN+1];
+
+	// the watch list of l for clauses of length len (0 for longer ones)
+	WatchList& _watchList( Literal l, int len );
+	static int _watchLength( Clause c );
+
+	void _addWatchedLiteral( Literal l, Clause c, int len );
+	void _removeWatchedLiteral( Literal l, Clause c, int len );
 	void _addImpLiterals( Literal one, Literal the_other, Clause c );
+	void _addTernLiterals( Clause c );
 
 	void _addWatchedClause( Clause c );
 
 	void initWatch();
 	void addNewWatchedClause( Clause c );
 	Clause propagateLiteral( Literal l, Literal* output_it );
+	template<int N>	// N: clause length, or 0 for longer clauses
+	Clause _propagateWatches( Literal falsified, Literal*& output_it );
+
+protected:	// clause relocation
+	/* Live clauses are copied into one arena: recently used clauses first,
+	 * then in the order propagation visits them, so that a literal's lists
+	 * point to neighbouring memory. Clauses added since the last
+	 * compaction are scattered on the heap. */
+	static const size_t	MIN_COMPACT_LITS = 1 << 16;
+
+	Literal*	arena;		// clauses relocated by the last compaction
+	size_t		arenaLits;	// size of the arena
+	size_t		dbLits;		// literals (incl. terminators) in all clauses
+
+	// ring of clauses that recently propagated or conflicted; these are
+	// placed first by the next compaction
+	static const unsigned	RECENT_SIZE = 1 << 12;	// power of two
+	Clause*		recentClauses;
+	unsigned	recentPos;
+
+	void _touch( Clause c ) { recentClauses[recentPos++ & (RECENT_SIZE-1)] = c; }
+
+	bool _inArena( Clause c ) const { return c >= arena && c < arena+arenaLits; }
+	Clause _relocate( Clause c, Literal*& dest, vector<Clause>& garbage );
+	void _relocateWatches( Literal l, Literal*& dest, vector<Clause>& garbage );
+	void compact();
+	void _maybeCompact();
 
 protected:	// assertion & backtracking
 	// (after backtracking) cancels all assignments set above the current level